@@ -0,0 +1,64 @@
+/* Maximum feerate closure.
+ *
+ * Input:
+ * N M // N: number of transactions, M: number of dependencies
+ * f_i, z_i // N lines, one for each transaction, f_i: the fee of transaction i,
+ * z_i: the size of transaction i
+ * a_i b_i // M lines, one for each dependency, a_i depends on b_i.
+ *
+ * Usage: maxfeerate-auto [-c] [tuning-file]
+ * The engine (BF, FP or GGT) is chosen for each input using the cost model
+ * in the tuning file written by maxfeerate-tune (default: maxfeerate.tune),
+ * or the built-in defaults if the file cannot be read. With -c the output is
+ * followed by an optimality certificate.
+ *
+ * If the environment variable MAXFEERATE_RECORD is set, the solved cluster is
+ * appended to the log it names, see maxfeerate-replay.
+ * */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "clusterlinearize.h"
+
+int main(int argc, char** argv) {
+        int arg = 1;
+        const bool with_certificate =
+            argc > arg && std::string(argv[arg]) == "-c";
+        if (with_certificate) arg++;
+        optimality_certificate cert;
+
+        const char* record_log = std::getenv("MAXFEERATE_RECORD");
+        if (record_log && !start_recording(record_log))
+                std::cerr << "cannot record to " << record_log << "\n";
+
+        solver_tuning tuning = default_tuning();
+        load_tuning(argc > arg ? argv[arg] : "maxfeerate.tune", tuning);
+
+        int N, M;
+        std::cin >> N >> M;
+        std::vector<feefrac> txs(N);
+        std::vector<int> dependency(N, 0);
+        for (int i = 0; i < N; i++) std::cin >> txs[i].fee >> txs[i].size;
+        for (int i = 0; i < M; i++) {
+                int a, b;
+                /* a->b, ie. a is a child tx of b */
+                std::cin >> a >> b;
+                dependency[a] |= (1 << b);
+        }
+        int answer = max_density_closure_auto(
+            tuning, txs, dependency, with_certificate ? &cert : nullptr);
+        auto fr = compute_feerate(txs, answer);
+        std::cout << fr << "\n";
+        std::cout << set_size(answer) << " ";
+        for (int i = 0; i < MAX_ID; i++)
+                if (in_set(answer, i)) {
+                        std::cout << i << " ";
+                }
+        std::cout << std::endl;
+        if (with_certificate) std::cout << cert << std::endl;
+        if (record_log) stop_recording();
+        return 0;
+}
@@ -7,33 +7,11 @@
  * a_i b_i // M lines, one for each dependency, a_i depends on b_i.
  * */
 
-#include <algorithm>
-#include <cassert>
 #include <iostream>
-#include <span>
 #include <vector>
 
 #include "clusterlinearize.h"
 
-/* Max density closure by Brute Force */
-int max_density_closure_BF(std::span<const feefrac> rates,
-                           std::span<const int> dependency) {
-        const int N = std::size(rates);
-        const int max_bitset = (1 << N);
-        int best_set = 0;
-        feefrac best_fr;
-
-        for (int bs = 1; bs < max_bitset; bs++)
-                if (is_closure(dependency, bs)) {
-                        feefrac fr = compute_feerate(rates, bs);
-                        if (best_fr < fr) {
-                                best_fr = fr;
-                                best_set = bs;
-                        }
-                }
-        return best_set;
-}
-
 int main() {
         int N, M;
         std::cin >> N >> M;
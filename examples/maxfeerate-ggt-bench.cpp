@@ -0,0 +1,59 @@
+/* Per-iteration cost of the parametric sequence in max_density_closure_ggt.
+ *
+ * Usage: maxfeerate-ggt-bench [N] [runs]
+ *
+ * Solves random clusters of N transactions (default: 31) and reports, for
+ * every iteration of the sequence, the average size of the contracted
+ * network and the average time spent in the min-cut.
+ * */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "clusterlinearize.h"
+#include "random-cluster.h"
+
+int main(int argc, char** argv) {
+        const int N = argc > 1 ? std::stoi(argv[1]) : MAX_ID - 1;
+        const int RUNS = argc > 2 ? std::stoi(argv[2]) : 1000;
+        if (N < 1 || N >= MAX_ID || RUNS < 1) return 1;
+        const double densities[] = {0.05, 0.2, 0.5};
+        std::mt19937 rng(25);
+        std::vector<feefrac> txs;
+        std::vector<int> dependency;
+        std::vector<parametric_iteration> trace;
+
+        for (double p : densities) {
+                /* totals by iteration index */
+                std::vector<long long> count, nodes, nanoseconds;
+                for (int r = 0; r < RUNS; r++) {
+                        random_cluster(rng, N, p, txs, dependency);
+                        trace.clear();
+                        max_density_closure_ggt(txs, dependency, nullptr,
+                                                nullptr, &trace);
+                        if (trace.size() > count.size()) {
+                                count.resize(trace.size(), 0);
+                                nodes.resize(trace.size(), 0);
+                                nanoseconds.resize(trace.size(), 0);
+                        }
+                        for (size_t i = 0; i < trace.size(); i++) {
+                                count[i]++;
+                                nodes[i] += trace[i].nodes;
+                                nanoseconds[i] += trace[i].nanoseconds;
+                        }
+                }
+
+                std::cout << "N = " << N << ", arc probability = " << p
+                          << ", runs = " << RUNS << "\n";
+                std::cout << "iteration\truns\tnodes\tmicroseconds\n";
+                for (size_t i = 0; i < count.size(); i++)
+                        std::cout << i << "\t\t" << count[i] << "\t"
+                                  << double(nodes[i]) / count[i] << "\t"
+                                  << 1e-3 * nanoseconds[i] / count[i]
+                                  << "\n";
+                std::cout << "\n";
+        }
+        return 0;
+}
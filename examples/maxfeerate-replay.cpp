@@ -0,0 +1,111 @@
+/* Replay a log written by the recorder.
+ *
+ * Usage: maxfeerate-replay <log> [engine] [tuning-file]
+ *
+ * Every recorded cluster is solved again with the given engine (bf, fp, ggt
+ * or auto, default: the engine that was recorded). The latency distribution
+ * of the recorded and replayed solves is reported, as well as every cluster
+ * for which the replayed answer has a different feerate than the recorded
+ * one.
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "clusterlinearize.h"
+
+void report_latency(const char* name, std::vector<long long> ns) {
+        std::cout << name << ":";
+        if (ns.empty()) {
+                std::cout << " no samples\n";
+                return;
+        }
+        std::sort(ns.begin(), ns.end());
+        double mean = 0;
+        for (long long x : ns) mean += x;
+        mean /= ns.size();
+        auto percentile = [&](double p) {
+                return 1e-3 * ns[std::min(ns.size() - 1,
+                                          size_t(p * ns.size()))];
+        };
+        std::cout << " mean " << 1e-3 * mean << "us"
+                  << " p50 " << percentile(0.5) << "us"
+                  << " p90 " << percentile(0.9) << "us"
+                  << " p99 " << percentile(0.99) << "us"
+                  << " max " << 1e-3 * ns.back() << "us\n";
+}
+
+int main(int argc, char** argv) {
+        if (argc < 2) {
+                std::cerr << "usage: " << argv[0]
+                          << " <log> [bf|fp|ggt|auto] [tuning-file]\n";
+                return 1;
+        }
+        std::ifstream log(argv[1], std::ios::binary);
+        if (!read_log_header(log)) {
+                std::cerr << "not a recorder log: " << argv[1] << "\n";
+                return 1;
+        }
+
+        /* -1: the recorded engine, N_ENGINES: auto */
+        int engine = -1;
+        if (argc > 2) {
+                const std::string name = argv[2];
+                if (name == "auto") engine = N_ENGINES;
+                for (int e = 0; e < N_ENGINES; e++)
+                        if (name == engine_name(solver_engine(e))) engine = e;
+                if (engine < 0) {
+                        std::cerr << "unknown engine " << name << "\n";
+                        return 1;
+                }
+        }
+        solver_tuning tuning = default_tuning();
+        load_tuning(argc > 3 ? argv[3] : "maxfeerate.tune", tuning);
+
+        std::vector<long long> recorded, replayed;
+        int n_records = 0, n_different = 0, n_same_rate = 0;
+        solve_record rec;
+        while (read_record(log, rec)) {
+                std::span<const feefrac> rates(rec.rates, rec.N);
+                std::span<const int> dependency(rec.dependency, rec.N);
+
+                using clock = std::chrono::steady_clock;
+                const auto start = clock::now();
+                int answer;
+                if (engine == N_ENGINES)
+                        answer =
+                            max_density_closure_auto(tuning, rates, dependency);
+                else
+                        answer = max_density_closure(
+                            solver_engine(engine < 0 ? rec.engine : engine),
+                            rates, dependency);
+                replayed.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        clock::now() - start)
+                        .count());
+                recorded.push_back(rec.solve_time);
+
+                const feefrac fr_rec = compute_feerate(rates, rec.answer);
+                const feefrac fr = compute_feerate(rates, answer);
+                if (fr_rec < fr || fr < fr_rec) {
+                        n_different++;
+                        std::cout << "record " << n_records << " (N = " << rec.N
+                                  << ", " << engine_name(rec.engine)
+                                  << "): recorded " << fr_rec << ", replayed "
+                                  << fr << "\n";
+                } else if (answer != rec.answer)
+                        n_same_rate++;
+                n_records++;
+        }
+
+        std::cout << n_records << " records, " << n_different
+                  << " with a different feerate, " << n_same_rate
+                  << " with a different set of the same feerate\n";
+        report_latency("recorded", recorded);
+        report_latency("replayed", replayed);
+        return n_different > 0 ? 2 : 0;
+}
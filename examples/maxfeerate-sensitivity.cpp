@@ -0,0 +1,48 @@
+/* Fee sensitivity of the maximum feerate closure.
+ *
+ * Input:
+ * N M // N: number of transactions, M: number of dependencies
+ * f_i, z_i // N lines, one for each transaction, f_i: the fee of transaction i,
+ * z_i: the size of transaction i
+ * a_i b_i // M lines, one for each dependency, a_i depends on b_i.
+ *
+ * Output: the maximum feerate closure as maxfeerate-fp, followed by N lines
+ * "i lo hi", the range of fees of transaction i over which the closure
+ * remains optimal.
+ * */
+
+#include <iostream>
+#include <vector>
+
+#include "clusterlinearize.h"
+
+int main() {
+        int N, M;
+        std::cin >> N >> M;
+        std::vector<feefrac> txs(N);
+        std::vector<int> dependency(N, 0);
+        for (int i = 0; i < N; i++) std::cin >> txs[i].fee >> txs[i].size;
+        for (int i = 0; i < M; i++) {
+                int a, b;
+                /* a->b, ie. a is a child tx of b */
+                std::cin >> a >> b;
+                dependency[a] |= (1 << b);
+        }
+        optimality_certificate cert;
+        int answer = max_density_closure_FP(txs, dependency, &cert);
+        auto fr = compute_feerate(txs, answer);
+        std::cout << fr << "\n";
+        std::cout << set_size(answer) << " ";
+        for (int i = 0; i < MAX_ID; i++)
+                if (in_set(answer, i)) {
+                        std::cout << i << " ";
+                }
+        std::cout << std::endl;
+
+        auto ranges = fee_sensitivity(txs, dependency, answer, cert);
+        if (std::ssize(ranges) != N) return 1;
+        for (int i = 0; i < N; i++)
+                std::cout << i << " " << ranges[i].lo << " " << ranges[i].hi
+                          << "\n";
+        return 0;
+}
@@ -0,0 +1,218 @@
+/* Calibrate the cost model used by maxfeerate-auto.
+ *
+ * Usage: maxfeerate-tune [tuning-file]
+ *
+ * Every engine is timed on random clusters of varying size and dependency
+ * density, the coefficients of the cost model (see solver_tuning) are fitted
+ * by least squares and written to the tuning file (default:
+ * maxfeerate.tune). For clusters of small, medium and large size the
+ * average time of the engine chosen by the model is then compared with the
+ * one of every engine and with the fastest engine for each cluster.
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "clusterlinearize.h"
+#include "random-cluster.h"
+
+/* Average running time in seconds, repeat until the measurement is long
+ * enough to be meaningful. */
+double time_engine(solver_engine e, std::span<const feefrac> txs,
+                   std::span<const int> dependency) {
+        using clock = std::chrono::steady_clock;
+        const auto min_time = std::chrono::milliseconds(1);
+        int runs = 0;
+        volatile int sink = 0;
+        auto start = clock::now();
+        auto elapsed = start - start;
+        do {
+                sink = max_density_closure(e, txs, dependency);
+                runs++;
+                elapsed = clock::now() - start;
+        } while (elapsed < min_time);
+        (void)sink;
+        return std::chrono::duration<double>(elapsed).count() / runs;
+}
+
+/* Solve the linear system A x = b restricted to the rows and columns in
+ * `terms` (a bitset of the 3 terms) by Gaussian elimination with partial
+ * pivoting, the other unknowns are 0. Return false if it is singular. */
+bool solve_terms(const double A_in[3][3], const double b_in[3], int terms,
+                 double x[3]) {
+        int idx[3], n = 0;
+        for (int k = 0; k < 3; k++)
+                if (in_set(terms, k)) idx[n++] = k;
+        double A[3][3], b[3];
+        for (int r = 0; r < n; r++) {
+                for (int c = 0; c < n; c++) A[r][c] = A_in[idx[r]][idx[c]];
+                b[r] = b_in[idx[r]];
+        }
+        for (int c = 0; c < n; c++) {
+                int p = c;
+                for (int r = c + 1; r < n; r++)
+                        if (std::abs(A[r][c]) > std::abs(A[p][c])) p = r;
+                if (A[p][c] == 0) return false;
+                std::swap(A[p], A[c]);
+                std::swap(b[p], b[c]);
+                for (int r = c + 1; r < n; r++) {
+                        double k = A[r][c] / A[c][c];
+                        for (int j = c; j < n; j++) A[r][j] -= k * A[c][j];
+                        b[r] -= k * b[c];
+                }
+        }
+        double y[3];
+        for (int c = n - 1; c >= 0; c--) {
+                y[c] = b[c];
+                for (int j = c + 1; j < n; j++) y[c] -= A[c][j] * y[j];
+                y[c] /= A[c][c];
+        }
+        x[0] = x[1] = x[2] = 0;
+        for (int r = 0; r < n; r++) x[idx[r]] = y[r];
+        return true;
+}
+
+/* Non-negative least squares for 3 unknowns: the best among the
+ * unconstrained fits on every subset of terms that are non-negative. The
+ * weighted residual is yy - 2 x.b + x.A.x. */
+bool fit_non_negative(const double A[3][3], const double b[3], double yy,
+                      double best[3]) {
+        double best_residual = 0;
+        bool found = false;
+        for (int terms = 1; terms < 8; terms++) {
+                double x[3];
+                if (!solve_terms(A, b, terms, x)) continue;
+                if (x[0] < 0 || x[1] < 0 || x[2] < 0) continue;
+                double residual = yy;
+                for (int r = 0; r < 3; r++) {
+                        residual -= 2 * x[r] * b[r];
+                        for (int c = 0; c < 3; c++)
+                                residual += x[r] * A[r][c] * x[c];
+                }
+                if (!found || residual < best_residual) {
+                        best_residual = residual;
+                        for (int k = 0; k < 3; k++) best[k] = x[k];
+                        found = true;
+                }
+        }
+        return found;
+}
+
+int main(int argc, char** argv) {
+        const char* filename = argc > 1 ? argv[1] : "maxfeerate.tune";
+        const int MAX_N = MAX_ID - 1, SAMPLES = 30;
+        const double densities[] = {0.05, 0.2, 0.5, 0.9};
+        std::mt19937 rng(25);
+        std::vector<feefrac> txs;
+        std::vector<int> dependency;
+
+        /* a measured cluster, used to evaluate the fitted model */
+        struct sample {
+                std::vector<int> dependency;
+                double time[N_ENGINES];
+        };
+        std::vector<sample> samples;
+
+        /* Normal equations of the least squares fit of
+         *      time = setup + node * nodes + arc * arcs.
+         * The running time of an engine varies a lot between clusters of the
+         * same size, we fit the average over SAMPLES clusters of every size
+         * and density, each average is weighted by 1/time^2 so that we
+         * minimize the relative error. */
+        double A[N_ENGINES][3][3]{}, b[N_ENGINES][3]{}, yy[N_ENGINES]{};
+
+        for (int N = 2; N <= MAX_N; N++)
+                for (double p : densities) {
+                        double t[N_ENGINES]{}, x[N_ENGINES][3]{};
+                        for (int s = 0; s < SAMPLES; s++) {
+                                random_cluster(rng, N, p, txs, dependency);
+                                sample smp{dependency, {}};
+                                int M = 0;
+                                for (int d : dependency) M += set_size(d);
+
+                                for (int e = 0; e < N_ENGINES; e++) {
+                                        smp.time[e] = -1;
+                                        if (e == ENGINE_BF && N > MAX_N_BF)
+                                                continue;
+                                        double nodes, arcs;
+                                        cost_terms(solver_engine(e), N, M,
+                                                   nodes, arcs);
+                                        smp.time[e] = time_engine(
+                                            solver_engine(e), txs, dependency);
+                                        t[e] += smp.time[e] / SAMPLES;
+                                        x[e][0] += 1.0 / SAMPLES;
+                                        x[e][1] += nodes / SAMPLES;
+                                        x[e][2] += arcs / SAMPLES;
+                                }
+                                samples.push_back(smp);
+                        }
+                        for (int e = 0; e < N_ENGINES; e++) {
+                                if (t[e] <= 0) continue;
+                                const double w = 1 / (t[e] * t[e]);
+                                for (int r = 0; r < 3; r++) {
+                                        for (int c = 0; c < 3; c++)
+                                                A[e][r][c] +=
+                                                    w * x[e][r] * x[e][c];
+                                        b[e][r] += w * x[e][r] * t[e];
+                                }
+                                yy[e] += w * t[e] * t[e];
+                        }
+                }
+
+        solver_tuning tuning = default_tuning();
+        for (int e = 0; e < N_ENGINES; e++) {
+                double x[3];
+                /* the cost must not become negative or decrease with the
+                 * size of the cluster */
+                if (!fit_non_negative(A[e], b[e], yy[e], x)) continue;
+                tuning.setup[e] = x[0];
+                tuning.node[e] = x[1];
+                tuning.arc[e] = x[2];
+                std::cout << engine_name(solver_engine(e)) << " " << x[0]
+                          << " " << x[1] << " " << x[2] << "\n";
+        }
+
+        /* How well does the fitted model choose? For clusters in a range
+         * of sizes, compare the average time of the model's choice with the
+         * one of every engine and with the fastest engine for each cluster.
+         * BF is left out where it was not timed. */
+        const int bands[][2] = {{2, 8}, {9, MAX_N_BF}, {MAX_N_BF + 1, MAX_N}};
+        std::cout << "N\tbf\tfp\tggt\tauto\tfastest\t(microseconds)\n";
+        for (const auto& band : bands) {
+                double total[N_ENGINES]{}, chosen = 0, fastest = 0;
+                int count = 0;
+                for (const auto& smp : samples) {
+                        const int N = std::size(smp.dependency);
+                        if (N < band[0] || N > band[1]) continue;
+                        count++;
+                        chosen += smp.time[choose_engine(tuning,
+                                                         smp.dependency)];
+                        double best = smp.time[ENGINE_GGT];
+                        for (int k = 0; k < N_ENGINES; k++) {
+                                if (smp.time[k] < 0) continue;
+                                total[k] += smp.time[k];
+                                best = std::min(best, smp.time[k]);
+                        }
+                        fastest += best;
+                }
+                std::cout << band[0] << "-" << band[1];
+                for (int e = 0; e < N_ENGINES; e++) {
+                        if (e == ENGINE_BF && band[1] > MAX_N_BF)
+                                std::cout << "\t-";
+                        else
+                                std::cout << "\t" << 1e6 * total[e] / count;
+                }
+                std::cout << "\t" << 1e6 * chosen / count << "\t"
+                          << 1e6 * fastest / count << "\n";
+        }
+
+        if (!save_tuning(filename, tuning)) {
+                std::cerr << "cannot write " << filename << "\n";
+                return 1;
+        }
+        return 0;
+}
@@ -5,35 +5,18 @@
  * f_i, z_i // N lines, one for each transaction, f_i: the fee of transaction i,
  * z_i: the size of transaction i
  * a_i b_i // M lines, one for each dependency, a_i depends on b_i.
+ *
+ * followed by the solution as printed by the solvers, optionally followed by
+ * an optimality certificate (see -c). A certificate is verified in O(N+M),
+ * if nothing follows the solution one is computed with a single maxflow.
  * */
 
-#include <algorithm>
-#include <cassert>
 #include <iostream>
-#include <span>
+#include <string>
 #include <vector>
 
 #include "clusterlinearize.h"
 
-/* Max density closure by Brute Force */
-int max_density_closure_BF(std::span<const feefrac> rates,
-                           std::span<const int> dependency) {
-        const int N = std::size(rates);
-        const int max_bitset = (1 << N);
-        int best_set = 0;
-        feefrac best_fr;
-
-        for (int bs = 1; bs < max_bitset; bs++)
-                if (is_closure(dependency, bs)) {
-                        feefrac fr = compute_feerate(rates, bs);
-                        if (best_fr < fr) {
-                                best_fr = fr;
-                                best_set = bs;
-                        }
-                }
-        return best_set;
-}
-
 int main() {
         int N, M;
 
@@ -48,15 +31,12 @@ int main() {
                 std::cin >> a >> b;
                 dependency[a] |= (1 << b);
         }
-        int answer = max_density_closure_BF(txs, dependency);
-        auto fbest = compute_feerate(txs, answer);
 
         /* now read the solution */
-        double sol_rate;
+        /* the rate is NAN for the empty set, only fee and size are checked */
+        std::string sol_rate;
         feefrac fsol;
         std::cin >> sol_rate >> fsol.fee >> fsol.size;
-        /* Not optimal */
-        if (fsol < fbest) return 1;
         int solset = 0;
         int solsize = 0;
         std::cin >> solsize;
@@ -71,5 +51,19 @@ int main() {
         if (!(compute_feerate(txs, solset) == fsol)) return 1;
         /* The reported solution is not a closure */
         if (!is_closure(dependency, solset)) return 1;
+
+        /* Not optimal */
+        optimality_certificate cert;
+        if ((std::cin >> std::ws).eof()) {
+                /* no certificate, compute one */
+                if (!make_certificate(txs, dependency, solset, cert))
+                        return 1;
+                return 0;
+        }
+        /* a certificate that does not parse or is followed by anything is
+         * as good as a wrong one */
+        if (!read_certificate(std::cin, cert)) return 1;
+        if (!(std::cin >> std::ws).eof()) return 1;
+        if (!verify_certificate(txs, dependency, solset, cert)) return 1;
         return 0;
 }
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "clusterlinearize.h"
+
+/* A random cluster in which tx i may depend on any tx j<i with the given
+ * probability. */
+inline void random_cluster(std::mt19937& rng, int N, double density,
+                           std::vector<feefrac>& txs,
+                           std::vector<int>& dependency) {
+        std::uniform_int_distribution<unsigned int> fee(0, 10000);
+        std::uniform_int_distribution<unsigned int> size(1, 1000);
+        std::bernoulli_distribution arc(density);
+        txs.resize(N);
+        dependency.assign(N, 0);
+        for (int i = 0; i < N; i++) {
+                txs[i].fee = fee(rng);
+                txs[i].size = size(rng);
+                for (int j = 0; j < i; j++)
+                        if (arc(rng)) dependency[i] |= (1 << j);
+        }
+}
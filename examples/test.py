@@ -1,5 +1,6 @@
 import io
 import copy
+import os
 import random
 import subprocess
 import sys
@@ -87,6 +88,110 @@ def random_topology(rates, m):
         add_arc(a,b)
     return tcase(txs)
 
+# brute force checks of the outputs that maxfeerate-validate does not read
+
+UINT_MAX = 2**32-1
+
+def closures(test_case, reverse=False):
+    # every non-empty set closed under dependencies (descendants if reverse)
+    n = len(test_case.txs)
+    arcs = test_case.dependencies()
+    if reverse:
+        arcs = [ (b,a) for a,b in arcs ]
+    for s in range(1, 2**n):
+        if all( (s>>b)&1 for a,b in arcs if (s>>a)&1 ):
+            yield s
+
+def set_rate(test_case, s, fees):
+    fee = sum( fees[t.idx] for t in test_case.txs if (s>>t.idx)&1 )
+    size = sum( t.size for t in test_case.txs if (s>>t.idx)&1 )
+    return fee, size
+
+def parse_set(lines):
+    # "rate fee size" then "k i_1 ... i_k"
+    rate = lines[0].split()
+    ids = [ int(x) for x in lines[1].split() ]
+    assert ids[0]==len(ids)-1
+    s = 0
+    for i in ids[1:]:
+        s |= 1<<i
+    return int(rate[1]), int(rate[2]), s
+
+def check_sensitivity(test_case, lines):
+    # "i lo hi": the answer is optimal for every fee of tx i in [lo, hi] and
+    # only then, the fees for which it is optimal form an interval
+    n = len(test_case.txs)
+    if n==0:
+        return True
+    _, _, answer = parse_set(lines)
+    ranges = [ [ int(x) for x in l.split() ] for l in lines[2:] ]
+    if len(ranges)!=n:
+        return False
+    def optimal(fees):
+        f, z = set_rate(test_case, answer, fees)
+        for c in closures(test_case):
+            fc, zc = set_rate(test_case, c, fees)
+            if fc*z > f*zc:
+                return False
+        return True
+    for i, lo, hi in ranges:
+        fees = [ t.fee for t in test_case.txs ]
+        # the fees of the cluster must add up within an unsigned int
+        max_fee = max(fees[i], UINT_MAX-(sum(fees)-fees[i]))
+        if not 0<=lo<=fees[i]<=hi<=max_fee:
+            return False
+        for fee, expected in [(lo, True), (hi, True),
+                              (lo-1, False), (hi+1, False)]:
+            if fee<0 or fee>max_fee:
+                continue
+            fees[i] = fee
+            if optimal(fees)!=expected:
+                return False
+    return True
+
+def check_eviction(test_case, lines):
+    # the set after "evict" is a minimum feerate set closed under descendants
+    n = len(test_case.txs)
+    if n==0:
+        return True
+    if len(lines)<3 or lines[0]!="evict":
+        return False
+    fee, size, evict = parse_set(lines[1:])
+    fees = [ t.fee for t in test_case.txs ]
+    candidates = list(closures(test_case, reverse=True))
+    if evict not in candidates:
+        return False
+    if set_rate(test_case, evict, fees)!=(fee, size):
+        return False
+    for c in candidates:
+        fc, zc = set_rate(test_case, c, fees)
+        if fc*size < fee*zc:
+            return False
+    return True
+
+def validate(test_in, test_out):
+    validate_exec = "../build/examples/maxfeerate-validate"
+    validate = subprocess.Popen([validate_exec], stdin=subprocess.PIPE,
+        stdout = subprocess.PIPE,
+        stderr = subprocess.PIPE)
+    validate.communicate(input=(test_in+test_out).encode('utf-8'))
+    validate.wait()
+    return validate.returncode==0
+
+def reject_and_report(test_case, forged_out):
+    print("===================")
+    test_in = io.StringIO()
+    test_case.write(test_in)
+    print("Input:")
+    print(test_in.getvalue())
+    print("Forged output:")
+    print(forged_out)
+    if validate(test_in.getvalue(), forged_out):
+        print("Forged answer accepted")
+        return FAIL
+    print("Rejected")
+    return OK
+
 def test_and_report(test_case, test_exec):
     print("===================")
     timeout = 2
@@ -95,7 +200,7 @@ def test_and_report(test_case, test_exec):
     print("Input:")
     print(test_in.getvalue())
     try:
-        test = subprocess.Popen([test_exec], stdin=subprocess.PIPE,
+        test = subprocess.Popen(test_exec, stdin=subprocess.PIPE,
             stdout = subprocess.PIPE,
             stderr = subprocess.PIPE)
         test_out = test.communicate(input=test_in.getvalue().encode('utf-8'),timeout=timeout)
@@ -113,18 +218,24 @@ def test_and_report(test_case, test_exec):
         return FAIL
     print("Output:")
     print(test_out[0].decode())
-    
-    validate_exec = "../build/examples/maxfeerate-validate"
-    try:
-        validate = subprocess.Popen([validate_exec], stdin=subprocess.PIPE,
-            stdout = subprocess.PIPE,
-            stderr = subprocess.PIPE)
-        validate_out = validate.communicate(
-            input=test_in.getvalue().encode('utf-8')+test_out[0])
-        validate.wait()
-        if validate.returncode!=0:
-            raise subprocess.CalledProcessError(test.returncode, test.args)
-    except subprocess.CalledProcessError as e:
+    print(test_out[1].decode())
+
+    # the solution is the first two lines
+    out_lines = test_out[0].decode().splitlines()
+    name = os.path.basename(test_exec[0])
+    if name=="maxfeerate-sensitivity":
+        if not check_sensitivity(test_case, out_lines):
+            print("Wrong Sensitivity")
+            return FAIL
+        solution = "\n".join(out_lines[:2])+"\n"
+    else:
+        solution = test_out[0].decode()
+    if "-e" in test_exec[1:]:
+        if not check_eviction(test_case, test_out[1].decode().splitlines()):
+            print("Wrong Eviction")
+            return FAIL
+
+    if not validate(test_in.getvalue(), solution):
         print("Wrong Answer")
         return FAIL
     print("Accepted")
@@ -142,10 +253,42 @@ test_cases.append(tcase([tx(0,2,4,[1]),tx(1,1,3)]))
 test_cases.append(tcase([tx(0,2,4,[1,2]),tx(1,1,3),tx(2,4,7)]))
 test_cases.append(tcase([tx(0,2,4,[1,2]),tx(1,1,3),tx(2,4,7),tx(3,8,10,[0])]))
 test_cases.append(random_topology([(1,1), (1,1), (2,3), (2,1), (3,4)], 7))
+test_cases.append(tcase([tx(0,0,1),tx(1,0,1)]))
+for n in range(2, 7):
+    for k in range(3):
+        rates = [ (random.randint(0,10), random.randint(1,10))
+                  for i in range(n) ]
+        m = random.randint(n-1, n*(n-1)//2)
+        test_cases.append(random_topology(rates, m))
+# large sizes, rates closer than the rounding in GGT
+test_cases.append(tcase([tx(0,689,38587),tx(1,370,87879),tx(2,716,80401),
+    tx(3,250,65936),tx(4,240,19276,[2]),tx(5,336,97436,[1]),
+    tx(6,219,48905,[2,5]),tx(7,814,28310,[2]),tx(8,588,7905,[0])]))
+for k in range(5):
+    rates = [ (random.randint(0,1000), random.randint(1,100000))
+              for i in range(8) ]
+    test_cases.append(random_topology(rates, random.randint(7, 12)))
+
+# wrong answers with a certificate that must not pass the validator
+forged_cases = []
+# the flow on the arcs from 2 overflows the conservation sums
+forged_cases.append((tcase([tx(0,1,1),tx(1,100,1,[0]),tx(2,0,100,[0])]),
+    "1 1 1\n1 0\n3\n1 0 99\n2 0 9223372036854775807\n"
+    "2 0 9223372036854775710\n1 0\n"))
+# an optimal answer followed by a truncated certificate
+forged_cases.append((tcase([tx(0,1,1),tx(1,100,1,[0]),tx(2,0,100,[0])]),
+    "50.5 101 2\n2 0 1\n2\n1 0"))
+# an optimal answer followed by something else than a certificate
+forged_cases.append((tcase([tx(0,1,1),tx(1,100,1,[0]),tx(2,0,100,[0])]),
+    "50.5 101 2\n2 0 1\nevict\n"))
 
 if __name__=="__main__":
-    assert len(sys.argv) == 2
+    # the solver and its arguments, eg. maxfeerate-fp -c
+    assert len(sys.argv) >= 2
+    for t, forged_out in forged_cases:
+        if reject_and_report(t, forged_out)==FAIL:
+            sys.exit(1)
     for t in test_cases:
-        ret = test_and_report(t, sys.argv[1])
+        ret = test_and_report(t, sys.argv[1:])
         if ret==FAIL:
             break
@@ -0,0 +1,161 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <span>
+#include <string>
+
+#include "clusterlinearize.h"
+
+const char* engine_name(solver_engine e) {
+        switch (e) {
+                case ENGINE_BF:
+                        return "bf";
+                case ENGINE_FP:
+                        return "fp";
+                case ENGINE_GGT:
+                        return "ggt";
+                default:
+                        return "unknown";
+        }
+}
+
+solver_tuning default_tuning() {
+        /* rough figures obtained with maxfeerate-tune on a x86_64 machine
+         * with an optimized build, run it to calibrate for the local one. */
+        solver_tuning t;
+        t.setup[ENGINE_BF] = 2.8e-7;
+        t.node[ENGINE_BF] = 1.0e-8;
+        t.arc[ENGINE_BF] = 0;
+        t.setup[ENGINE_FP] = 3.8e-7;
+        t.node[ENGINE_FP] = 1.1e-8;
+        t.arc[ENGINE_FP] = 2.5e-9;
+        t.setup[ENGINE_GGT] = 5.1e-7;
+        t.node[ENGINE_GGT] = 4.3e-8;
+        t.arc[ENGINE_GGT] = 7.7e-9;
+        return t;
+}
+
+bool load_tuning(const char* filename, solver_tuning& tuning) {
+        std::ifstream fd(filename);
+        if (!fd) return false;
+
+        solver_tuning t = tuning;
+        int found = 0;
+        std::string name;
+        double setup, node, arc;
+        while (fd >> name >> setup >> node >> arc) {
+                /* a negative cost could make BF look cheap at any size */
+                if (!(setup >= 0 && node >= 0 && arc >= 0) ||
+                    !std::isfinite(setup + node + arc))
+                        return false;
+                for (int e = 0; e < N_ENGINES; e++)
+                        if (name == engine_name(solver_engine(e))) {
+                                t.setup[e] = setup;
+                                t.node[e] = node;
+                                t.arc[e] = arc;
+                                found |= (1 << e);
+                        }
+        }
+        /* all engines must be present */
+        if (found != (1 << N_ENGINES) - 1) return false;
+        tuning = t;
+        return true;
+}
+
+bool save_tuning(const char* filename, const solver_tuning& tuning) {
+        std::ofstream fd(filename);
+        if (!fd) return false;
+        fd.precision(6);
+        for (int e = 0; e < N_ENGINES; e++)
+                fd << engine_name(solver_engine(e)) << " " << tuning.setup[e]
+                   << " " << tuning.node[e] << " " << tuning.arc[e] << "\n";
+        return bool(fd);
+}
+
+void cost_terms(solver_engine e, int N, int M, double& nodes, double& arcs) {
+        switch (e) {
+                case ENGINE_BF:
+                        nodes = std::ldexp(double(N), N);
+                        arcs = std::ldexp(double(M), N);
+                        break;
+                case ENGINE_FP:
+                        nodes = double(N) * N * std::log2(N + 1.0);
+                        arcs = double(N) * M * std::log2(N + 1.0);
+                        break;
+                default:
+                        nodes = double(N) * N;
+                        arcs = double(N) * M;
+                        break;
+        }
+}
+
+double estimate_cost(const solver_tuning& tuning, solver_engine e, int N,
+                     int M) {
+        double nodes, arcs;
+        cost_terms(e, N, M, nodes, arcs);
+        return tuning.setup[e] + tuning.node[e] * nodes +
+               tuning.arc[e] * arcs;
+}
+
+solver_engine choose_engine(const solver_tuning& tuning,
+                            std::span<const int> dependency) {
+        const int N = std::size(dependency);
+        int M = 0;
+        for (int i = 0; i < N; i++) M += set_size(dependency[i]);
+
+        solver_engine best = ENGINE_GGT;
+        double best_cost = estimate_cost(tuning, best, N, M);
+        for (int e = 0; e < N_ENGINES; e++) {
+                if (e == ENGINE_BF && N > MAX_N_BF) continue;
+                double cost = estimate_cost(tuning, solver_engine(e), N, M);
+                if (cost < best_cost) {
+                        best_cost = cost;
+                        best = solver_engine(e);
+                }
+        }
+        return best;
+}
+
+static int solve_with_engine(solver_engine e,
+                             std::span<const feefrac> rates,
+                             std::span<const int> dependency,
+                             optimality_certificate* cert) {
+        switch (e) {
+                case ENGINE_BF: {
+                        int answer = max_density_closure_BF(rates, dependency);
+                        if (cert)
+                                make_certificate(rates, dependency, answer,
+                                                 *cert);
+                        return answer;
+                }
+                case ENGINE_FP:
+                        return max_density_closure_FP(rates, dependency, cert);
+                default:
+                        return max_density_closure_ggt(rates, dependency, cert);
+        }
+}
+
+int max_density_closure(solver_engine e, std::span<const feefrac> rates,
+                        std::span<const int> dependency,
+                        optimality_certificate* cert) {
+        if (!recording_active())
+                return solve_with_engine(e, rates, dependency, cert);
+
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        int answer = solve_with_engine(e, rates, dependency, cert);
+        const auto solve_time = clock::now() - start;
+        record_solve(
+            e, rates, dependency, answer,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(solve_time)
+                .count());
+        return answer;
+}
+
+int max_density_closure_auto(const solver_tuning& tuning,
+                             std::span<const feefrac> rates,
+                             std::span<const int> dependency,
+                             optimality_certificate* cert) {
+        return max_density_closure(choose_engine(tuning, dependency), rates,
+                                   dependency, cert);
+}
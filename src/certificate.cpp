@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <iostream>
+#include <span>
+#include <vector>
+
+#include "clusterlinearize.h"
+
+std::ostream& operator<<(std::ostream& os, const optimality_certificate& c) {
+        os << c.flow.size() << "\n";
+        for (const auto& a : c.flow)
+                os << a.from << " " << a.to << " " << a.flow << "\n";
+        os << set_size(c.cut) << " ";
+        for (int i = 0; i < MAX_ID; i++)
+                if (in_set(c.cut, i)) os << i << " ";
+        return os;
+}
+
+bool read_certificate(std::istream& is, optimality_certificate& c) {
+        int K;
+        if (!(is >> K) || K < 0) return false;
+        c.flow.resize(K);
+        for (auto& a : c.flow)
+                if (!(is >> a.from >> a.to >> a.flow)) return false;
+        int size;
+        if (!(is >> size) || size < 0 || size > MAX_ID) return false;
+        c.cut = 0;
+        for (int i = 0, x; i < size; i++) {
+                if (!(is >> x) || x < 0 || x >= MAX_ID) return false;
+                c.cut |= (1 << x);
+        }
+        return true;
+}
+
+bool verify_certificate(std::span<const feefrac> rates,
+                        std::span<const int> dependency, int answer,
+                        const optimality_certificate& cert) {
+        const int N = std::size(rates);
+        const int all = (1 << N) - 1;
+
+        /* the answer and the cut are closures within the problem set */
+        if ((answer & all) != answer || (cert.cut & all) != cert.cut)
+                return false;
+        if (N > 0 && answer == 0) return false;
+        if (!is_closure(dependency, answer) ||
+            !is_closure(dependency, cert.cut))
+                return false;
+
+        const feefrac fr = compute_feerate(rates, answer);
+
+        /* The flow through any arc or node is at most the total capacity of
+         * the source arcs, larger figures in an untrusted certificate would
+         * overflow the sums below. */
+        long long source_capacity = 0;
+        for (int i = 0; i < N; i++)
+                source_capacity += std::max(rates[i].cross(fr), 0LL);
+
+        /* net flow out of each node through the dependency arcs */
+        std::vector<long long> out(N, 0);
+        for (const auto& a : cert.flow) {
+                if (a.from < 0 || a.from >= N || a.to < 0 || a.to >= N)
+                        return false;
+                /* flow only on existing arcs and in their direction */
+                if (!in_set(dependency[a.from], a.to) || a.flow < 0 ||
+                    a.flow > source_capacity)
+                        return false;
+                out[a.from] += a.flow;
+                out[a.to] -= a.flow;
+                if (out[a.from] > source_capacity ||
+                    out[a.to] < -source_capacity)
+                        return false;
+        }
+
+        /* every source arc is saturated and every sink arc receives a
+         * feasible flow, ie. the flow value is the sum of positive weights */
+        long long flow_value = 0, cut_capacity = 0;
+        for (int i = 0; i < N; i++) {
+                const long long w = rates[i].cross(fr);
+                const long long from_source = w > 0 ? w : 0;
+                const long long sink_capacity = w < 0 ? -w : 0;
+                const long long to_sink = from_source - out[i];
+                if (to_sink < 0 || to_sink > sink_capacity) return false;
+                flow_value += from_source;
+
+                /* capacity of the cut: source arcs into the sink side and
+                 * sink arcs out of the source side */
+                if (in_set(cert.cut, i))
+                        cut_capacity += sink_capacity;
+                else
+                        cut_capacity += from_source;
+        }
+
+        /* by duality the cut is minimum and the maximum weight closure has
+         * weight flow_value - cut_capacity = 0, no closure has a feerate
+         * higher than the answer */
+        return flow_value == cut_capacity;
+}
+
+bool make_certificate(std::span<const feefrac> rates,
+                      std::span<const int> dependency, int answer,
+                      optimality_certificate& cert) {
+        const int N = std::size(rates);
+        const feefrac fr = compute_feerate(rates, answer);
+        std::vector<long long> weights(N);
+        for (int i = 0; i < N; i++) weights[i] = rates[i].cross(fr);
+        max_weight_closure(weights, dependency, &cert);
+        return verify_certificate(rates, dependency, answer, cert);
+}
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <span>
+#include <vector>
 
 struct feefrac {
         unsigned int fee{0}, size{0};
@@ -46,3 +47,200 @@ feefrac compute_feerate(std::span<const feefrac> rates, int bitset);
 /* Given a dependency graph and a subset, answer whether the subset is a
  * closure, ie. doesn't have external dependencies. */
 bool is_closure(std::span<const int> dependency, int bitset);
+
+/* Certificate of optimality of a max density closure S.
+ *
+ * Let w[i] = fee[i] * size(S) - size[i] * fee(S), then S has maximum feerate
+ * iff the maximum weight closure in w has weight 0. By max-flow/min-cut
+ * duality that is the case iff in the network
+ *      source -> i (capacity w[i] if w[i] > 0),
+ *      i -> sink (capacity -w[i] if w[i] < 0),
+ *      i -> j (infinite capacity) if i depends on j,
+ * there is a flow that saturates every source arc. `flow` lists the flow on
+ * the dependency arcs, the flow on the source and sink arcs is implied by
+ * conservation. `cut` is the source side of a minimum cut, ie. a maximum
+ * weight closure. */
+struct optimality_certificate {
+        struct arc {
+                int from, to;
+                long long flow;
+        };
+        std::vector<arc> flow;
+        int cut{0};
+};
+
+/* Write/read a certificate: the number of arcs K, then K lines
+ * "from to flow", then the cut as a set "size i_1 i_2 ...". */
+std::ostream& operator<<(std::ostream& os, const optimality_certificate& c);
+bool read_certificate(std::istream& is, optimality_certificate& c);
+
+/* Check in O(N+M) that `cert` proves `answer` to be a maximum feerate
+ * closure. */
+bool verify_certificate(std::span<const feefrac> rates,
+                        std::span<const int> dependency, int answer,
+                        const optimality_certificate& cert);
+
+/* Compute a certificate for `answer` with a single maxflow at its feerate.
+ * Returns false if no certificate exists, ie. `answer` is not optimal. */
+bool make_certificate(std::span<const feefrac> rates,
+                      std::span<const int> dependency, int answer,
+                      optimality_certificate& cert);
+
+/* Interval of fees [lo, hi] of a transaction over which, all other fees
+ * being equal, a closure remains a maximum feerate closure. hi is capped so
+ * that the fees of the whole cluster still add up within an unsigned int. */
+struct fee_range {
+        unsigned int lo{0}, hi{0};
+};
+
+/* Fee sensitivity of every transaction for the optimal closure `answer`,
+ * computed from its certificate without re-solving the problem at trial
+ * fees. Returns an empty vector if the certificate is not valid. */
+std::vector<fee_range> fee_sensitivity(std::span<const feefrac> rates,
+                                       std::span<const int> dependency,
+                                       int answer,
+                                       const optimality_certificate& cert);
+
+/* Max density closure by Brute Force, O(2^N). */
+int max_density_closure_BF(std::span<const feefrac> rates,
+                           std::span<const int> dependency);
+
+/* Maximum weight closure using Goldberg-Tarjan's Preflow-Push. If `cert` is
+ * given the final flow on the dependency arcs and the cut are stored in it. */
+int max_weight_closure(std::span<const long long> weights,
+                       std::span<const int> dependency,
+                       optimality_certificate* cert = nullptr);
+
+/* Max density closure using Fractional Programming and maxflow. The last
+ * maxflow runs at the optimal feerate, if `cert` is given its flow is
+ * returned as certificate. */
+int max_density_closure_FP(std::span<const feefrac> rates,
+                           std::span<const int> dependency,
+                           optimality_certificate* cert = nullptr);
+
+/* Size of the contracted network and running time of one min-cut in the
+ * parametric sequence of max_density_closure_ggt. */
+struct parametric_iteration {
+        int nodes;
+        long long nanoseconds;
+};
+
+/* Max density closure using "A Fast Parametric Maximum Flow Algorithm" by
+ * Gallo, Grigoriadis and Tarjan. Weights are rounded in the parametric
+ * sequence, so if `cert` is given it is computed by make_certificate, if
+ * none exists the rounded answer was not optimal and max_density_closure_FP
+ * solves the cluster instead.
+ * If `min_density_set` is given the same workspace is used to compute the
+ * minimum density set closed under descendants, ie. the chunk to evict.
+ * If `trace` is given every min-cut of the sequence is recorded in it. */
+int max_density_closure_ggt(std::span<const feefrac> rates,
+                            std::span<const int> dependency,
+                            optimality_certificate* cert = nullptr,
+                            int* min_density_set = nullptr,
+                            std::vector<parametric_iteration>* trace = nullptr);
+
+/* The engines available to solve the max density closure. */
+enum solver_engine { ENGINE_BF = 0, ENGINE_FP, ENGINE_GGT, N_ENGINES };
+
+const char* engine_name(solver_engine e);
+
+/* Cost model for each engine: the estimated running time (in seconds) of
+ * engine e on a cluster with N transactions and M dependencies is
+ *
+ *      setup[e] + node[e] * nodes_e(N) + arc[e] * arcs_e(N, M),
+ *
+ * where the terms follow how each engine scales:
+ *  - BF enumerates every subset, nodes_BF = N * 2^N, arcs_BF = M * 2^N;
+ *  - GGT runs a single parametric sequence of preflow-push on a dense
+ *    network, nodes_GGT = N^2, arcs_GGT = N * M;
+ *  - FP runs a new maxflow from scratch for every rate of its increasing
+ *    sequence, a few that grow slowly with N, nodes_FP = N^2 log2(N+1),
+ *    arcs_FP = N * M log2(N+1). */
+struct solver_tuning {
+        double setup[N_ENGINES];
+        double node[N_ENGINES];
+        double arc[N_ENGINES];
+};
+
+/* BF is only calibrated, and hence only chosen, up to this cluster size. */
+const int MAX_N_BF = 16;
+
+/* Coefficients used when no tuning file is available. */
+solver_tuning default_tuning();
+
+/* Read/write the tuning file produced by maxfeerate-tune. The format is one
+ * line per engine: <name> <setup> <node> <arc>. Return false on failure,
+ * in which case `tuning` is left untouched by load_tuning. Coefficients must
+ * be finite and non-negative. */
+bool load_tuning(const char* filename, solver_tuning& tuning);
+bool save_tuning(const char* filename, const solver_tuning& tuning);
+
+/* The terms nodes_e(N) and arcs_e(N, M) of the cost model. */
+void cost_terms(solver_engine e, int N, int M, double& nodes, double& arcs);
+
+/* Estimated cost of solving a cluster of N transactions and M dependencies
+ * with engine e. */
+double estimate_cost(const solver_tuning& tuning, solver_engine e, int N,
+                     int M);
+
+/* Pick the engine with the lowest estimated cost, never BF above MAX_N_BF.
+ *
+ * The estimate only sees N and M (the density is M / (N (N-1) / 2)), it
+ * predicts the average over clusters of that shape, not the time of a given
+ * cluster. How many maxflows FP runs, and how long they take, depends on
+ * the fees: beyond a dozen transactions FP and GGT are each the faster one
+ * on about half of the clusters, and neither the density nor the shape of
+ * the graph tells which. The gain over always using GGT comes from BF and
+ * FP on small clusters, maxfeerate-tune reports it by cluster size. */
+solver_engine choose_engine(const solver_tuning& tuning,
+                            std::span<const int> dependency);
+
+/* Run the given engine, optionally producing a certificate. If the recorder
+ * is active the cluster is recorded (see start_recording). */
+int max_density_closure(solver_engine e, std::span<const feefrac> rates,
+                        std::span<const int> dependency,
+                        optimality_certificate* cert = nullptr);
+
+/* Max density closure dispatched to the cheapest engine. */
+int max_density_closure_auto(const solver_tuning& tuning,
+                             std::span<const feefrac> rates,
+                             std::span<const int> dependency,
+                             optimality_certificate* cert = nullptr);
+
+/* A solved cluster, as stored in the log written by the recorder. */
+struct solve_record {
+        long long timestamp{0};  /* nanoseconds since the epoch */
+        long long solve_time{0}; /* nanoseconds */
+        solver_engine engine{ENGINE_GGT};
+        int answer{0};
+        int N{0};
+        feefrac rates[MAX_ID];
+        int dependency[MAX_ID]{};
+};
+
+/* Opt-in recorder: while it is active every cluster solved with
+ * max_density_closure (and hence max_density_closure_auto) is appended to
+ * the binary log `filename`. Direct calls to the engines, eg.
+ * max_density_closure_FP, are not recorded. Solvers only copy the record
+ * into a lock-free buffer, a background thread writes it out. If the buffer
+ * is full the record is dropped rather than blocking the solver. Return
+ * false if the log cannot be opened or a recording is already active. */
+bool start_recording(const char* filename);
+
+/* Flush the buffer and close the log, done at exit if still recording. */
+void stop_recording();
+
+/* Number of records dropped because the buffer was full. */
+long long recording_dropped();
+
+/* Used by max_density_closure: is the recorder active, and queue a record of
+ * a solve that took `solve_time` nanoseconds. */
+bool recording_active();
+void record_solve(solver_engine e, std::span<const feefrac> rates,
+                  std::span<const int> dependency, int answer,
+                  long long solve_time);
+
+/* Read a log written by the recorder: first the header, then one record at
+ * a time until read_record returns false. */
+bool read_log_header(std::istream& is);
+bool read_record(std::istream& is, solve_record& rec);
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <queue>
+#include <span>
+#include <vector>
+
+#include "clusterlinearize.h"
+
+/* Only the nodes listed in `nodes` are part of the network, the others
+ * have been contracted into the source. */
+static int can_reach_sink(std::span<const int> nodes,
+                          std::span<const int> dependency,
+                          std::span<const long long> cap_to_sink,
+                          std::span<const long long> flow,
+                          std::span<const long long> flow_to_sink) {
+        const int N = dependency.size();
+        int answer = 0;
+        std::queue<int> Q;
+
+        /* starting from the sink, which nodes can reach it in the residual
+         * network? */
+        for (int i : nodes)
+                if (cap_to_sink[i] > flow_to_sink[i]) {
+                        answer |= (1 << i);
+                        Q.push(i);
+                }
+
+        while (!Q.empty()) {
+                int node = Q.front();
+                Q.pop();
+
+                for (int prev : nodes)
+                        /* scan all nodes that can reach me in the residual
+                         * network */
+                        if (!in_set(answer, prev) &&
+                            (in_set(dependency[prev], node) ||
+                             flow[node * N + prev] > 0)) {
+                                answer |= (1 << prev);
+                                Q.push(prev);
+                        }
+        }
+
+        return answer;
+}
+
+/* FIXME: too many arguments, we might need fewer */
+static int compute_min_cut(std::span<const int> nodes,
+                           std::span<const long long> cap_to_source,
+                           std::span<const long long> cap_to_sink,
+                           std::span<const int> dependency,
+                           std::span<long long> flow,
+                           std::span<long long> flow_to_source,
+                           std::span<long long> flow_to_sink,
+                           std::span<long long> excess,
+                           std::span<int> distance) {
+        const int N = std::size(dependency);
+        std::queue<int> Q;
+
+        /* normal push */
+        auto push = [&](int node, int next) {
+                long long f = excess[node];
+                if (in_set(dependency[node], next)) {
+                        /* arc with infinite capacity */
+                        flow[node * N + next] += f;
+                } else if (in_set(dependency[next], node)) {
+                        /* finite residual capacity */
+                        f = std::min(f, flow[next * N + node]);
+                        flow[next * N + node] -= f;
+                } else {
+                        /* they are not connected */
+                        f = 0;
+                }
+
+                excess[node] -= f;
+                excess[next] += f;
+                if (excess[next] == f && f > 0) Q.push(next);
+        };
+
+        /* a push towards the sink */
+        auto push_to_sink = [&](int node) {
+                long long f = std::min(excess[node],
+                                       cap_to_sink[node] - flow_to_sink[node]);
+                excess[node] -= f;
+                flow_to_sink[node] += f;
+        };
+
+        /* pushes towards the source are not required since we are interested in
+         * the min-cut and not the state of the maxflow. */
+
+        /* discharge = push/relabel while node is active */
+        auto discharge = [&](int node) {
+                /* a node with distance >= N+2 cannot reach the sink */
+                while (distance[node] < N + 2 && excess[node] > 0) {
+                        /* can we push to the sink? */
+                        push_to_sink(node);
+                        if (excess[node] == 0) break;
+
+                        /* can we push to another node? */
+                        for (int next : nodes)
+                                if (distance[node] > distance[next])
+                                        push(node, next);
+                        if (excess[node] == 0) break;
+
+                        /* cannot push any more but we are still active,
+                         * relabel.
+                         * FIXME: we may save a bit of time if we collect the
+                         * minimum label of all neighboring nodes and use
+                         * relabel to that + 1. */
+                        distance[node]++;
+                }
+        };
+
+        /* identify the first active nodes and queue them */
+        for (int i : nodes)
+                if (distance[i] < N + 2 && excess[i] > 0) Q.push(i);
+
+        /* push/relabel until there are no more active nodes */
+        while (!Q.empty()) {
+                int node = Q.front();
+                Q.pop();
+                discharge(node);
+        }
+
+        return can_reach_sink(nodes, dependency, cap_to_sink, flow,
+                              flow_to_sink);
+}
+
+/* Max density closure using "A Fast Parametric Maximum Flow Algorithm" by
+ * Gallo, Grigoriadis and Tarjan. */
+int max_density_closure_ggt(std::span<const feefrac> rates,
+                            std::span<const int> dependency,
+                            optimality_certificate* cert,
+                            int* min_density_set,
+                            std::vector<parametric_iteration>* trace) {
+        const int N = std::size(rates);
+
+        /* By the nesting property X_{i+1}<=X_{i} a node that has left the
+         * candidate set never returns, it is contracted into the source
+         * (this is the reversed graph) and its arcs are dropped. Every
+         * iteration only touches the nodes listed here. */
+        std::vector<int> nodes;
+        auto contract = [&](int candidates) {
+                nodes.clear();
+                for (int i = 0; i < N; i++)
+                        if (in_set(candidates, i)) nodes.push_back(i);
+        };
+
+        /* weights on the nodes weight[i] = fee[i] - size[i] * target_rate */
+        std::vector<long long> weights(N);
+
+        /* capacity on the network */
+        std::vector<long long> cap_to_sink(N, 0), cap_to_source(N, 0);
+
+        auto build_graph = [&]() {
+                for (int i : nodes) {
+                        /* Notice this is the reversed graph. */
+                        if (weights[i] > 0) {
+                                cap_to_sink[i] = weights[i];
+                                cap_to_source[i] = 0;
+                        } else {
+                                cap_to_source[i] = -weights[i];
+                                cap_to_sink[i] = 0;
+                        }
+                }
+        };
+
+        /* state of the flow */
+        std::vector<long long> excess(N, 0), flow(N * N, 0), flow_to_sink(N, 0),
+            flow_to_source(N, 0);
+
+        /* a valid labeling the source and sink are not explicity here */
+        std::vector<int> distance(N, 0);
+
+        /* how we update the weights of nodes */
+        const long long FRACTION_LIFT = 1000000;
+        auto compute_weights = [&](feefrac target) {
+                for (int i : nodes) {
+                        weights[i] =
+                            FRACTION_LIFT * rates[i].fee -
+                            rates[i].size *
+                                ((FRACTION_LIFT * target.fee) / target.size);
+                }
+        };
+
+        /* weights for the minimum density problem, the target rate is
+         * rounded up. A set with density below target has a positive
+         * weight, but so may a set with density slightly above it, which
+         * can then win the cut over the lower one. */
+        auto compute_reverse_weights = [&](feefrac target) {
+                for (int i : nodes) {
+                        weights[i] = rates[i].size *
+                                         ((FRACTION_LIFT * target.fee +
+                                           target.size - 1) /
+                                          target.size) -
+                                     FRACTION_LIFT * rates[i].fee;
+                }
+        };
+
+        /* clear the flow and labels between two parametric sequences */
+        auto reset_flow = [&]() {
+                std::fill(excess.begin(), excess.end(), 0);
+                std::fill(flow.begin(), flow.end(), 0);
+                std::fill(flow_to_sink.begin(), flow_to_sink.end(), 0);
+                std::fill(flow_to_source.begin(), flow_to_source.end(), 0);
+                std::fill(distance.begin(), distance.end(), 0);
+        };
+
+        /* saturate the source and reduce the flow on the sink side, it is
+         * assumed that the capacity on the source arcs cannot decrease and
+         * the capacity on the sink arcs cannot increase. */
+        auto saturate_source = [&]() {
+                long long df;
+                for (int i : nodes) {
+                        // saturate source arcs
+                        if (distance[i] < N + 2) {
+                                df = cap_to_source[i] - flow_to_source[i];
+                                assert(df >= 0);
+                                excess[i] += df;
+                                flow_to_source[i] += df;
+                                assert(cap_to_source[i] >= flow_to_source[i]);
+                        }
+
+                        // reduce the flow on the sink arcs
+                        df = flow_to_sink[i] -
+                             std::min(flow_to_sink[i], cap_to_sink[i]);
+                        assert(df >= 0);
+                        excess[i] += df;
+                        flow_to_sink[i] -= df;
+                        assert(cap_to_sink[i] >= flow_to_sink[i]);
+                }
+        };
+
+        /* one step of the parametric sequence on the contracted network */
+        auto min_cut = [&](std::span<const int> arcs) {
+                using clock = std::chrono::steady_clock;
+                const auto start = trace ? clock::now() : clock::time_point{};
+                build_graph();
+                saturate_source();
+                int x = compute_min_cut(nodes, cap_to_source, cap_to_sink,
+                                        arcs, flow, flow_to_source,
+                                        flow_to_sink, excess, distance);
+                if (trace)
+                        trace->push_back(
+                            {int(nodes.size()),
+                             std::chrono::duration_cast<
+                                 std::chrono::nanoseconds>(clock::now() -
+                                                           start)
+                                 .count()});
+                return x;
+        };
+
+        /* arcs directions inverted */
+        std::vector<int> rev_dependency(N, 0);
+        for (int i = 0; i < N; i++)
+                for (int j = 0; j < N; j++) {
+                        if (in_set(dependency[i], j))
+                                rev_dependency[j] |= (1 << i);
+                }
+
+        /* first min-cut */
+        contract((1 << N) - 1);
+        compute_weights(feefrac{0, 1});
+        int best_set = min_cut(rev_dependency);
+
+        /* the cut at rate zero is empty iff no transaction pays a fee, then
+         * every closure has feerate zero and the whole cluster is one */
+        if (best_set == 0) best_set = (1 << N) - 1;
+        feefrac best_fr = compute_feerate(rates, best_set);
+
+        /* produce an increasing sequence of rates, we re-use the flow and
+         * labels from every iterations. */
+        while (true) {
+                contract(best_set);
+                compute_weights(best_fr);
+                int x = min_cut(rev_dependency);
+
+                /* verify the nesting property X_{i+1}<=X_{i} */
+                assert((best_set & x) == x);
+
+                feefrac fr = compute_feerate(rates, x);
+                if (best_fr < fr) {
+                        best_fr = fr;
+                        best_set = x;
+                } else {
+                        break;
+                }
+        }
+
+        /* The weights are rounded, two rates closer than 1/FRACTION_LIFT
+         * are not told apart and best_set may fall short of the optimum.
+         * Then no certificate exists, solve again with exact weights. */
+        if (cert && !make_certificate(rates, dependency, best_set, *cert))
+                best_set = max_density_closure_FP(rates, dependency, cert);
+
+        if (min_density_set) {
+                /* Minimum density set closed under descendants, ie. a
+                 * closure for rev_dependency. It is a max weight closure
+                 * with weights size[i] * target_rate - fee[i], in the
+                 * reversed graph the arcs are those of dependency. Starting
+                 * from the whole cluster the target rate decreases, hence
+                 * the weights decrease and the flow can be re-used. */
+                reset_flow();
+                int worst_set = (1 << N) - 1;
+                feefrac worst_fr = compute_feerate(rates, worst_set);
+                while (N > 0) {
+                        contract(worst_set);
+                        compute_reverse_weights(worst_fr);
+                        int x = min_cut(dependency);
+
+                        /* verify the nesting property X_{i+1}<=X_{i} */
+                        assert((worst_set & x) == x);
+
+                        /* the empty set compares lower than any feerate */
+                        feefrac fr = compute_feerate(rates, x);
+                        if (x != 0 && fr < worst_fr) {
+                                worst_fr = fr;
+                                worst_set = x;
+                        } else {
+                                break;
+                        }
+                }
+
+                /* The rounding may have stopped the sequence early, a max
+                 * weight closure with exact weights size[i] * worst_rate -
+                 * fee[i] finds any lower set, until none is left. */
+                std::vector<long long> exact(N);
+                while (N > 0) {
+                        for (int i = 0; i < N; i++)
+                                exact[i] = worst_fr.cross(rates[i]);
+                        int x = max_weight_closure(exact, rev_dependency);
+                        long long w = 0;
+                        for (int i = 0; i < N; i++)
+                                if (in_set(x, i)) w += exact[i];
+                        if (w <= 0) break;
+                        worst_set = x;
+                        worst_fr = compute_feerate(rates, x);
+                }
+                *min_density_set = worst_set;
+        }
+        return best_set;
+}
@@ -0,0 +1,253 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "clusterlinearize.h"
+
+namespace {
+
+/* The log starts with this header, followed by the records, each one is
+ *      timestamp (8 bytes), solve_time (8), engine (1), N (1), answer (4),
+ *      N times: fee (4), size (4), dependency (4),
+ * in the byte order of the machine that wrote it. */
+const char LOG_MAGIC[8] = {'M', 'F', 'R', 'L', 'O', 'G', '0', '1'};
+
+/* Bounded multi-producer single-consumer queue by D. Vyukov, every slot
+ * carries a sequence number that tells whether it is free or full. */
+const size_t BUFFER_SLOTS = 1024;
+
+struct buffer_slot {
+        std::atomic<size_t> sequence;
+        solve_record record;
+};
+
+struct recorder_state {
+        buffer_slot slots[BUFFER_SLOTS];
+        std::atomic<size_t> enqueue_pos{0};
+        size_t dequeue_pos{0};
+
+        std::atomic<bool> enabled{false};
+        std::atomic<int> writers{0};
+        std::atomic<bool> stopping{false};
+        std::atomic<long long> dropped{0};
+
+        std::mutex control; /* serializes start/stop, not the solvers */
+        std::ofstream log;
+        std::thread flusher;
+
+        recorder_state() {
+                for (size_t i = 0; i < BUFFER_SLOTS; i++)
+                        slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        /* a program may exit while recording, the flusher must not outlive
+         * the state */
+        ~recorder_state() { stop(); }
+
+        void stop() {
+                std::lock_guard<std::mutex> lock(control);
+                if (!flusher.joinable()) return;
+
+                /* No new writers, wait for those in flight. Together with
+                 * record_solve this is Dekker's handshake: each side stores
+                 * its flag then loads the other's, which only works if the
+                 * four accesses are sequentially consistent. */
+                enabled.store(false, std::memory_order_seq_cst);
+                while (writers.load(std::memory_order_seq_cst) > 0)
+                        std::this_thread::yield();
+
+                stopping.store(true, std::memory_order_release);
+                flusher.join();
+                log.close();
+        }
+
+        bool push(const solve_record& rec) {
+                size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+                buffer_slot* slot;
+                while (true) {
+                        slot = &slots[pos % BUFFER_SLOTS];
+                        size_t seq =
+                            slot->sequence.load(std::memory_order_acquire);
+                        long long diff = (long long)seq - (long long)pos;
+                        if (diff == 0) {
+                                if (enqueue_pos.compare_exchange_weak(
+                                        pos, pos + 1,
+                                        std::memory_order_relaxed))
+                                        break;
+                        } else if (diff < 0) {
+                                /* full */
+                                return false;
+                        } else {
+                                pos = enqueue_pos.load(
+                                    std::memory_order_relaxed);
+                        }
+                }
+                slot->record = rec;
+                slot->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+        }
+
+        bool pop(solve_record& rec) {
+                buffer_slot* slot = &slots[dequeue_pos % BUFFER_SLOTS];
+                size_t seq = slot->sequence.load(std::memory_order_acquire);
+                if (seq != dequeue_pos + 1) return false;
+                rec = slot->record;
+                slot->sequence.store(dequeue_pos + BUFFER_SLOTS,
+                                     std::memory_order_release);
+                dequeue_pos++;
+                return true;
+        }
+};
+
+recorder_state& recorder() {
+        static recorder_state state;
+        return state;
+}
+
+template <class T>
+void write_raw(std::ostream& os, T value) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        os.write(bytes, sizeof(T));
+}
+
+template <class T>
+bool read_raw(std::istream& is, T& value) {
+        char bytes[sizeof(T)];
+        if (!is.read(bytes, sizeof(T))) return false;
+        std::memcpy(&value, bytes, sizeof(T));
+        return true;
+}
+
+void write_record(std::ostream& os, const solve_record& rec) {
+        write_raw<int64_t>(os, rec.timestamp);
+        write_raw<int64_t>(os, rec.solve_time);
+        write_raw<uint8_t>(os, rec.engine);
+        write_raw<uint8_t>(os, rec.N);
+        write_raw<int32_t>(os, rec.answer);
+        for (int i = 0; i < rec.N; i++) {
+                write_raw<uint32_t>(os, rec.rates[i].fee);
+                write_raw<uint32_t>(os, rec.rates[i].size);
+                write_raw<int32_t>(os, rec.dependency[i]);
+        }
+}
+
+}  // namespace
+
+bool read_log_header(std::istream& is) {
+        char magic[sizeof(LOG_MAGIC)];
+        if (!is.read(magic, sizeof(magic))) return false;
+        return std::memcmp(magic, LOG_MAGIC, sizeof(magic)) == 0;
+}
+
+bool read_record(std::istream& is, solve_record& rec) {
+        int64_t timestamp, solve_time;
+        uint8_t engine, N;
+        int32_t answer;
+        if (!read_raw(is, timestamp) || !read_raw(is, solve_time) ||
+            !read_raw(is, engine) || !read_raw(is, N) ||
+            !read_raw(is, answer))
+                return false;
+        if (engine >= N_ENGINES || N > MAX_ID) return false;
+        rec.timestamp = timestamp;
+        rec.solve_time = solve_time;
+        rec.engine = solver_engine(engine);
+        rec.N = N;
+        rec.answer = answer;
+        for (int i = 0; i < rec.N; i++) {
+                uint32_t fee, size;
+                int32_t dep;
+                if (!read_raw(is, fee) || !read_raw(is, size) ||
+                    !read_raw(is, dep))
+                        return false;
+                rec.rates[i].fee = fee;
+                rec.rates[i].size = size;
+                rec.dependency[i] = dep;
+        }
+        return true;
+}
+
+/* background thread: drain the buffer into the log */
+static void flush_loop(recorder_state& r) {
+        solve_record rec;
+        while (true) {
+                /* read the flag before draining, so that nothing pushed
+                 * before the stop is left behind */
+                const bool last = r.stopping.load(std::memory_order_acquire);
+                int n = 0;
+                while (r.pop(rec)) {
+                        write_record(r.log, rec);
+                        n++;
+                }
+                if (n > 0) r.log.flush();
+                if (last) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+}
+
+bool start_recording(const char* filename) {
+        recorder_state& r = recorder();
+        std::lock_guard<std::mutex> lock(r.control);
+        if (r.flusher.joinable()) return false;
+
+        /* new logs start with the header */
+        bool empty;
+        {
+                std::ifstream existing(filename, std::ios::binary |
+                                                     std::ios::ate);
+                empty = !existing || existing.tellg() == 0;
+        }
+        r.log.open(filename, std::ios::binary | std::ios::app);
+        if (!r.log) return false;
+        if (empty) r.log.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+
+        r.stopping.store(false);
+        r.flusher = std::thread(flush_loop, std::ref(r));
+        r.enabled.store(true, std::memory_order_release);
+        return true;
+}
+
+void stop_recording() { recorder().stop(); }
+
+long long recording_dropped() {
+        return recorder().dropped.load(std::memory_order_relaxed);
+}
+
+bool recording_active() {
+        return recorder().enabled.load(std::memory_order_relaxed);
+}
+
+void record_solve(solver_engine e, std::span<const feefrac> rates,
+                  std::span<const int> dependency, int answer,
+                  long long solve_time) {
+        recorder_state& r = recorder();
+        const int N = std::size(rates);
+        if (N > MAX_ID) return;
+
+        /* announce ourselves before checking the flag, stop_recording waits
+         * for us (see recorder_state::stop) */
+        r.writers.fetch_add(1, std::memory_order_seq_cst);
+        if (r.enabled.load(std::memory_order_seq_cst)) {
+                solve_record rec;
+                rec.timestamp =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+                rec.solve_time = solve_time;
+                rec.engine = e;
+                rec.answer = answer;
+                rec.N = N;
+                for (int i = 0; i < N; i++) {
+                        rec.rates[i] = rates[i];
+                        rec.dependency[i] = dependency[i];
+                }
+                if (!r.push(rec))
+                        r.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        r.writers.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <climits>
+#include <queue>
+#include <span>
+#include <vector>
+
+#include "clusterlinearize.h"
+
+/* Maxflow from `source` to the sink in the residual network of a
+ * certificate, using Edmonds-Karp. `flow` is the N*N matrix of flow on the
+ * dependency arcs and `sink_residual` the residual capacity of the arcs to
+ * the sink, both are left untouched. */
+static long long residual_maxflow(std::span<const int> dependency,
+                                  std::vector<long long> flow,
+                                  std::vector<long long> sink_residual,
+                                  int source) {
+        const int N = std::size(dependency);
+        const int SINK = N;
+        long long total = 0;
+        std::vector<int> parent(N + 1);
+
+        /* residual capacity of the arc a->b, -1 is infinite */
+        auto residual = [&](int a, int b) -> long long {
+                if (b == SINK) return sink_residual[a];
+                if (in_set(dependency[a], b)) return -1;
+                if (in_set(dependency[b], a)) return flow[b * N + a];
+                return 0;
+        };
+
+        while (true) {
+                std::fill(parent.begin(), parent.end(), -1);
+                parent[source] = source;
+                std::queue<int> Q;
+                Q.push(source);
+                while (!Q.empty() && parent[SINK] < 0) {
+                        int node = Q.front();
+                        Q.pop();
+                        for (int next = 0; next <= N; next++)
+                                if (parent[next] < 0 &&
+                                    residual(node, next) != 0) {
+                                        parent[next] = node;
+                                        Q.push(next);
+                                }
+                }
+                if (parent[SINK] < 0) break;
+
+                /* the arc to the sink is finite, hence the path is */
+                long long f = LLONG_MAX;
+                for (int b = SINK; b != source; b = parent[b]) {
+                        long long r = residual(parent[b], b);
+                        if (r >= 0) f = std::min(f, r);
+                }
+                for (int b = SINK; b != source; b = parent[b]) {
+                        int a = parent[b];
+                        if (b == SINK)
+                                sink_residual[a] -= f;
+                        else if (in_set(dependency[a], b))
+                                flow[a * N + b] += f;
+                        else
+                                flow[b * N + a] -= f;
+                }
+                total += f;
+        }
+        return total;
+}
+
+std::vector<fee_range> fee_sensitivity(std::span<const feefrac> rates,
+                                       std::span<const int> dependency,
+                                       int answer,
+                                       const optimality_certificate& cert) {
+        const int N = std::size(rates);
+        std::vector<fee_range> ranges;
+        if (!verify_certificate(rates, dependency, answer, cert))
+                return ranges;
+
+        const feefrac fr = compute_feerate(rates, answer);
+        std::vector<long long> weights(N);
+        for (int i = 0; i < N; i++) weights[i] = rates[i].cross(fr);
+
+        /* the final residual network */
+        std::vector<long long> flow(N * N, 0), sink_residual(N, 0);
+        std::vector<long long> out(N, 0);
+        for (const auto& a : cert.flow) {
+                flow[a.from * N + a.to] += a.flow;
+                out[a.from] += a.flow;
+                out[a.to] -= a.flow;
+        }
+        for (int i = 0; i < N; i++) {
+                const long long from_source = std::max(weights[i], 0LL);
+                const long long to_sink = from_source - out[i];
+                sink_residual[i] = std::max(-weights[i], 0LL) - to_sink;
+        }
+
+        /* If fee[i] changes by d, the answer S stays optimal iff for every
+         * closure C
+         *      w(C) + d * a(C) <= 0,
+         * where a(C) = size(S) [i in C] - size(C) [i in S]. The largest
+         * (smallest) such d is found by Newton's method on the breakpoints of
+         * the convex function h(d) = max_C w(C) + d * a(C), every step is a
+         * maximum weight closure. */
+        auto coefficient = [&](int i, int j) -> long long {
+                long long a = 0;
+                if (j == i) a += fr.size;
+                if (in_set(answer, i)) a -= rates[j].size;
+                return a;
+        };
+        std::vector<long long> step_weights(N);
+        auto h = [&](int i, long long d, long long& w_C, long long& a_C) {
+                for (int j = 0; j < N; j++)
+                        step_weights[j] = weights[j] + d * coefficient(i, j);
+                int C = max_weight_closure(step_weights, dependency);
+                w_C = a_C = 0;
+                for (int j = 0; j < N; j++)
+                        if (in_set(C, j)) {
+                                w_C += weights[j];
+                                a_C += coefficient(i, j);
+                        }
+                return w_C + d * a_C;
+        };
+
+        /* fees are summed in an unsigned int by compute_feerate, the fee
+         * of i can only rise as long as the fee of the cluster fits */
+        long long total_fee = 0;
+        for (int i = 0; i < N; i++) total_fee += rates[i].fee;
+
+        ranges.resize(N);
+        for (int i = 0; i < N; i++) {
+                const long long fee = rates[i].fee;
+                const long long max_fee =
+                    std::max<long long>(fee, UINT_MAX - (total_fee - fee));
+                long long w_C, a_C;
+
+                if (!in_set(answer, i)) {
+                        /* Lowering the fee of i only worsens the closures
+                         * containing it. Raising it by d adds d * size(S) to
+                         * the source arc of i, the flow increases by
+                         * min(d * size(S), r) where r is the maxflow from i
+                         * in the final residual network. */
+                        long long r = residual_maxflow(dependency, flow,
+                                                       sink_residual, i);
+                        ranges[i].lo = 0;
+                        ranges[i].hi =
+                            std::min<long long>(max_fee, fee + r / fr.size);
+                        continue;
+                }
+
+                /* upper bound, Newton from above */
+                long long d = max_fee - fee;
+                while (h(i, d, w_C, a_C) > 0) d = (-w_C) / a_C;
+                ranges[i].hi = fee + d;
+
+                /* lower bound, Newton from below */
+                d = -fee;
+                while (h(i, d, w_C, a_C) > 0) d = -((-w_C) / (-a_C));
+                ranges[i].lo = fee + d;
+        }
+        return ranges;
+}